@@ -2,63 +2,141 @@
 #include <cstdio>
 #include <cstdlib>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <ctime>
 #include <unistd.h>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <deque>
+#include <typeinfo>
 #include "dau.h"
 #include "clop.h" 
 
 namespace noto {
 
+// arguments still to be parsed, with their position in argv.  argv is read as we go (so a long command
+// line is never copied) and expanded flags (-abc => -a -b -c) are pushed back on the front
+class argqueue_t {
+
+	const int argc;
+	const char * const * const argv;
+	int next;  // next argv index not yet read
+	std::deque< std::pair<std::string,int> > pushed;  // arguments pushed back on the front
+
+  public:
+
+	argqueue_t(const int c, const char * const * const v) : argc(c), argv(v), next(1) { }
+
+	bool empty() const { return pushed.empty() && next >= argc; }
+	std::pair<std::string,int> front() const { return pushed.empty() ? std::make_pair(std::string(argv[next]), next) : pushed.front(); }
+	void pop_front() { if (pushed.empty()) { next++; } else { pushed.pop_front(); } }
+	void push_front(const std::pair<std::string,int> &arg) { pushed.push_front(arg); }
+};
+
 // subroutine for clop_t::parse
-bool process_arg(const std::string &arg, std::deque<std::string> &Q, const std::map<const std::string,option_t*> &flagset, std::map<const void *,std::string> &assigned_options);
+bool process_arg(const std::string &arg, int argi, argqueue_t &Q, const std::map<const std::string,option_t*> &flagset, std::map<const void *,std::string> &assigned_options);
 
 std::vector<std::string> clop_t::parse(const int argc, const char * const * const argv) {
 
-	this->assigned_options.clear();
+	std::vector<std::string> result; // return value: list of arguments not interpreted as option flags or values
 
-	// create mutable set of arguments from argv
-	std::deque<std::string> Q; 
-	for (int a = 1; a < argc; a++) {
-		Q.push_back(argv[a]); 
+	// actions have to be called, so parsing can only be skipped if there aren't any
+	bool cache = !cache_directory.empty();
+	for (size_t i = 0; cache && i < options.size(); ++i) { 
+		cache = !options[i]->has_side_effects();
 	}
-	std::vector<std::string> result; // return value: list of arguments not interpreted as option flags or values
+	if (cache && this->load_cache(argc, argv, result)) { 
+		return result;
+	}
+
+	this->parse(argc, argv, [&result](const std::string &arg) { result.push_back(arg); });
+	if (!positionals.empty()) { 
+		this->assign_positionals(result);
+		result.clear();
+	}
+
+	if (cache) { 
+		this->save_cache(argc, argv, result);
+		this->prune_cache();
+	}
+	return result;
+}
+
+void
+clop_t::assign_positionals(const std::vector<std::string> &args) {
+
+	// how many arguments go to the variadic positional (if any)?
+	size_t fixed = 0; // number of arguments for non-variadic positionals
+	const positional_t *variadic = NULL;
+	for (size_t p = 0; p < positionals.size(); ++p) {
+		if (positionals[p]->variadic) {
+			variadic = positionals[p];
+		} else { 
+			fixed += positionals[p]->arity;
+		}
+	}
+	if (args.size() < fixed || (!variadic && args.size() != fixed)) {
+		throw DAU() << "expected " << (variadic ? "at least " : "") << fixed << " argument" << (fixed == 1 ? "" : "s") << ", got " << args.size();
+	}
+	if (variadic && (args.size() - fixed) % variadic->arity) {
+		throw DAU() << "argument " << variadic->help.flags[0] << " expects a multiple of " << variadic->arity << " values, got " << (args.size() - fixed);
+	}
+
+	size_t begin = 0;
+	for (size_t p = 0; p < positionals.size(); ++p) {
+		const size_t count = positionals[p]->variadic ? (args.size() - fixed) : positionals[p]->arity;
+		positionals[p]->assign(args, begin, count);
+		if (count) {
+			assigned_options[positionals[p]->varptr()] = positionals[p]->help.flags[0];
+		}
+		begin += count;
+	}
+}
+
+void clop_t::parse(const int argc, const char * const * const argv, const std::function<void(const std::string&)> &positional) {
+
+	this->assigned_options.clear();
+
+	// mutable set of arguments from argv
+	argqueue_t Q(argc, argv); 
 
 	// look for option flags in arguments
 	while (!Q.empty()) { 
 
-		const std::string arg = Q.front(); 
+		const std::string arg = Q.front().first; 
+		const int argi = Q.front().second; 
 		Q.pop_front(); 
 		if (this->interpret_double_hypen && arg == std::string("--")) { 
 			// assume this means all arguments after this are literal/verbatim
 			while (!Q.empty()) { 
-				result.push_back(Q.front());
+				positional(Q.front().first);
 				Q.pop_front(); 
 			}
-		} else if (!process_arg(arg, Q, flagset, assigned_options)) { 
+		} else if (!process_arg(arg, argi, Q, flagset, assigned_options)) { 
 			// regular argument
 			if (this->hypen_arg_error && arg[0]=='-') {
 				throw DAU() << "illegal option \"" << arg << "\"";
 			}
-			result.push_back(arg); 
+			positional(arg); 
 		}
 	}
-	return result;
 }
 
 // sub-subroutine for clop_t::parse
-void assign_value(option_t *option, const std::string &flag, const std::string &value, std::map<const void *,std::string> &assigned_options) {
+void assign_value(option_t *option, const std::string &flag, const std::string &value, int argi, std::map<const void *,std::string> &assigned_options) {
 
-	if (assigned_options.find(option->varptr()) != assigned_options.end()) {
+	if (!option->repeatable() && assigned_options.find(option->varptr()) != assigned_options.end()) {
 		throw DAU() << "option " << (*option) << " double-initialized with " << assigned_options[ option->varptr() ] << " and " << flag;
 	}
 
 	assigned_options[option->varptr()] = flag;
 
 	if (option->requires_value()) {
-		option->assign(value); 
+		option->assign_at(value, flag, argi); 
 	} else {
 		option->toggle();
 	}
@@ -77,7 +155,7 @@ expand_arg(const std::string &arg) {
 }
 
 // subroutine for clop_t::parse
-bool process_arg(const std::string &arg, std::deque<std::string> &Q, const std::map<const std::string,option_t*> &flagset, std::map<const void *,std::string> &assigned_options)
+bool process_arg(const std::string &arg, int argi, argqueue_t &Q, const std::map<const std::string,option_t*> &flagset, std::map<const void *,std::string> &assigned_options)
 {
 	// if arg is -abc for boolean options -a, -b, -c, reset Q and continue
 	if (arg.size() >= 3 && arg[0] == '-' && arg[1] != '-') { 
@@ -93,7 +171,7 @@ bool process_arg(const std::string &arg, std::deque<std::string> &Q, const std::
 
 		if (legal) { 
 			for (size_t i = expanded_args.size() - 1; i < expanded_args.size(); --i) { 
-				Q.push_front(expanded_args[i]);
+				Q.push_front(std::make_pair(expanded_args[i], argi));
 			}
 			return true;
 		} 
@@ -112,10 +190,10 @@ bool process_arg(const std::string &arg, std::deque<std::string> &Q, const std::
 				if (Q.empty()) {
 					throw DAU() << "option " << (*option) << ", flag " << flag << " requires a value";
 				}
-				assign_value(option, flag, Q.front(), assigned_options); 
+				assign_value(option, flag, Q.front().first, Q.front().second, assigned_options); 
 				Q.pop_front();
 			} else { 
-				assign_value(option, flag, "", assigned_options); 
+				assign_value(option, flag, "", argi, assigned_options); 
 			}
 			return true;
 		}
@@ -127,13 +205,393 @@ bool process_arg(const std::string &arg, std::deque<std::string> &Q, const std::
 		{ 
 			// looks like: -flag=value
 			// +1 <=> skip over '=' character
-			assign_value(option, flag, arg.substr(flag.size() + 1), assigned_options);
+			assign_value(option, flag, arg.substr(flag.size() + 1), argi, assigned_options);
 			return true;
 		}
 	}
 	return false;
 }
 
+// make help info for a new option, checking its flags
+help_t
+make_help(const char *shortflag, const char *longflag, const char *description) {
+
+	if (!shortflag && !longflag) { throw DAU() << "creation of option without an indicator flag"; }
+	if (shortflag && !legal_short_flag(shortflag)) { throw DAU() << "illegal option flag: " << shortflag; }
+	if (longflag && !legal_long_flag(longflag)) { throw DAU() << "illegal option name: " << longflag; }
+
+	help_t help; 
+	if (shortflag) { help.flags.push_back(std::string(shortflag)); }
+	if (longflag) { help.flags.push_back(std::string(longflag)); }
+	help.description = description;
+	return help;
+}
+
+void
+clop_t::insert(option_t *option) {
+
+	for (std::map<const std::string,option_t *>::const_iterator it=flagset.begin(); it!=flagset.end(); it++) { // for each existing flag -> option
+
+		if (it->second->varptr() == option->varptr()) { throw DAU() << "option " << (*(it->second)) << " and " << (*option) << " associated with the same variable"; }
+		for (size_t f = 0; f < option->help.flags.size(); ++f) { 
+			if (it->first == option->help.flags[f]) { throw DAU() << "option " << (option->help.flags[f][1] == '-' ? "name " : "flag ") << option->help.flags[f] << " assigned to multiple options: (i) " << (*(it->second)) << ", and (ii) " << (*option); }
+		}
+
+	} // next previous flag,option
+	for (size_t p = 0; p < positionals.size(); ++p) { 
+		if (positionals[p]->varptr() == option->varptr()) { throw DAU() << "option " << (*option) << " and positional argument " << positionals[p]->help.flags[0] << " associated with the same variable"; }
+	}
+
+	// add option and its flags now
+	this->options.push_back(option);
+	for (size_t f = 0; f < option->help.flags.size(); ++f) { 
+		flagset[option->help.flags[f]] = option;
+	}
+}
+
+void
+clop_t::insert(positional_t *positional) {
+
+	for (size_t p = 0; p < positionals.size(); ++p) { 
+		if (positionals[p]->varptr() == positional->varptr()) { throw DAU() << "positional arguments " << positionals[p]->help.flags[0] << " and " << positional->help.flags[0] << " associated with the same variable"; }
+		if (positionals[p]->variadic && positional->variadic) { throw DAU() << "positional arguments " << positionals[p]->help.flags[0] << " and " << positional->help.flags[0] << " are both variadic"; }
+	}
+	for (size_t i = 0; i < options.size(); ++i) { 
+		if (options[i]->varptr() == positional->varptr()) { throw DAU() << "option " << (*options[i]) << " and positional argument " << positional->help.flags[0] << " associated with the same variable"; }
+	}
+	this->positionals.push_back(positional);
+}
+
+void 
+clop_t::add_action(const std::function<void()> &action, const char *flag, const char *help) {
+	if (!flag) { throw DAU() << "creation of option without an indicator flag"; }
+	if (legal_short_flag(flag)) { return this->add_action(action, flag, NULL, help); }
+	if (legal_long_flag(flag)) { return this->add_action(action, NULL, flag, help); }
+	throw DAU() << "illegal option flag/name: " << flag; 
+}
+
+void 
+clop_t::add_action(const std::function<void()> &action, const char *shortflag, const char *longflag, const char *help_description) {
+
+	if (!action) { throw DAU() << "creation of option with empty action"; }
+	help_t help = make_help(shortflag, longflag, help_description); 
+	this->insert(new action_option_t<void>(action, help));
+}
+
+// subroutine for clop_t::schema_hash and the parse cache (FNV-1a)
+uint64_t fnv1a(uint64_t hash, const char *bytes, size_t size) {
+	for (size_t i = 0; i < size; ++i) { 
+		hash = (hash ^ (unsigned char)bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+// with the terminating null, so "ab","c" differs from "a","bc"
+uint64_t fnv1a(uint64_t hash, const std::string &str) { return fnv1a(hash, str.c_str(), str.size() + 1); }
+
+uint64_t
+clop_t::schema_hash() const {
+
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < options.size(); ++i) { 
+		const option_t *option = options[i];
+		hash = fnv1a(hash, typeid(*option).name()); // the option's subclass, which includes the variable type
+		for (size_t f = 0; f < option->help.flags.size(); ++f) { 
+			hash = fnv1a(hash, option->help.flags[f]);
+		}
+		hash = fnv1a(hash, option->help.metavar);
+		hash = fnv1a(hash, option->help.default_value);
+	}
+	for (size_t p = 0; p < positionals.size(); ++p) { 
+		const positional_t *positional = positionals[p];
+		std::ostringstream oss; 
+		oss << positional->arity << (positional->variadic ? "..." : "");
+		hash = fnv1a(hash, typeid(*positional).name());
+		hash = fnv1a(hash, positional->help.flags[0]);
+		hash = fnv1a(hash, oss.str());
+	}
+	return hash;
+}
+
+// serialized parsed state starts with these, then the schema hash
+const char SERIAL_MAGIC[] = "CLOP";
+const uint32_t SERIAL_VERSION = 1;
+const uint32_t SERIAL_END = 0xffffffff; // ends the lists of set options and positional arguments
+
+// a set option (or positional argument) in serialized state: where its value is, not yet decoded
+struct serial_entry_t {
+	uint32_t index;  // in clop_t::options (or positionals)
+	std::string flag;  // flag used (options only)
+	const char *value; 
+	uint64_t size;
+};
+
+// subroutine for clop_t::deserialize: read a list of entries (up to SERIAL_END), return false if malformed
+bool decode_entries(const char *&p, const char *end, size_t count, bool flags, std::vector<serial_entry_t> &entries) {
+	for (;;) { 
+		serial_entry_t entry;
+		if (!decode_value(p, end, &entry.index)) { return false; }
+		if (entry.index == SERIAL_END) { return true; }
+		if (entry.index >= count || (flags && !decode_value(p, end, &entry.flag)) 
+				|| !decode_value(p, end, &entry.size) || (uint64_t)(end - p) < entry.size) { 
+			return false;
+		}
+		entry.value = p;
+		p += entry.size;
+		entries.push_back(entry);
+	}
+}
+
+std::string
+clop_t::serialize(const std::vector<std::string> &arguments) const {
+
+	std::string blob(SERIAL_MAGIC, 4); 
+	encode_value(blob, SERIAL_VERSION);
+	encode_value(blob, this->schema_hash());
+
+	// set options: index, flag used, size of value, value
+	for (size_t i = 0; i < options.size(); ++i) { 
+		std::map<const void *,std::string>::const_iterator it = assigned_options.find(options[i]->varptr());
+		if (it != assigned_options.end()) { 
+			std::string value;
+			options[i]->encode(value);
+			encode_value(blob, (uint32_t)i);
+			encode_value(blob, it->second);
+			encode_value(blob, (uint64_t)value.size());
+			blob += value;
+		}
+	}
+	encode_value(blob, SERIAL_END);
+
+	// set positional arguments: index, size of value, value
+	for (size_t p = 0; p < positionals.size(); ++p) { 
+		if (assigned_options.find(positionals[p]->varptr()) != assigned_options.end()) { 
+			std::string value;
+			positionals[p]->encode(value);
+			encode_value(blob, (uint32_t)p);
+			encode_value(blob, (uint64_t)value.size());
+			blob += value;
+		}
+	}
+	encode_value(blob, SERIAL_END);
+
+	encode_values(blob, arguments);
+	return blob;
+}
+
+void
+clop_t::serialize(int fd, const std::vector<std::string> &arguments) const {
+
+	const std::string blob = this->serialize(arguments);
+	for (size_t done = 0; done < blob.size(); ) { 
+		const ssize_t n = write(fd, blob.data() + done, blob.size() - done);
+		if (n < 0 && errno != EINTR) { throw DAU() << "cannot write serialized options: " << strerror(errno); }
+		if (n > 0) { done += n; }
+	}
+}
+
+std::vector<std::string>
+clop_t::deserialize(const char *blob, size_t size) {
+
+	const char *p = blob, *end = blob + size;
+	uint32_t version;
+	uint64_t hash;
+	if (size < 4 || memcmp(p, SERIAL_MAGIC, 4)) { throw DAU() << "not serialized options"; }
+	p += 4;
+	if (!decode_value(p, end, &version) || version != SERIAL_VERSION) { throw DAU() << "serialized options are from a different version of clop"; }
+	if (!decode_value(p, end, &hash) || hash != this->schema_hash()) { throw DAU() << "serialized options don't match the declared options"; }
+
+	// check the whole blob (its layout, then each value) before assigning anything
+	std::vector<serial_entry_t> set_options, set_positionals;
+	std::vector<std::string> arguments;
+	if (!decode_entries(p, end, options.size(), true, set_options)
+			|| !decode_entries(p, end, positionals.size(), false, set_positionals)
+			|| !decode_values(p, end, &arguments) || p != end) { 
+		throw DAU() << "serialized options are corrupt";
+	}
+
+	for (size_t e = 0; e < set_options.size(); ++e) { 
+		if (!options[set_options[e].index]->check(set_options[e].value, set_options[e].value + set_options[e].size)) { 
+			throw DAU() << "serialized value of option " << (*options[set_options[e].index]) << " is corrupt";
+		}
+	}
+	for (size_t e = 0; e < set_positionals.size(); ++e) { 
+		if (!positionals[set_positionals[e].index]->check(set_positionals[e].value, set_positionals[e].value + set_positionals[e].size)) { 
+			throw DAU() << "serialized value of argument " << positionals[set_positionals[e].index]->help.flags[0] << " is corrupt";
+		}
+	}
+
+	// now assign (only positional arguments converted again can fail, and they were converted when parsed)
+	this->assigned_options.clear();
+	for (size_t e = 0; e < set_options.size(); ++e) { 
+		option_t *option = options[set_options[e].index];
+		const char *value = set_options[e].value, *value_end = value + set_options[e].size;
+		if (!option->decode(value, value_end) || value != value_end) { throw DAU() << "serialized value of option " << (*option) << " is corrupt"; }
+		assigned_options[option->varptr()] = set_options[e].flag;
+	}
+	for (size_t e = 0; e < set_positionals.size(); ++e) { 
+		positional_t *positional = positionals[set_positionals[e].index];
+		const char *value = set_positionals[e].value, *value_end = value + set_positionals[e].size;
+		if (!positional->decode(value, value_end) || value != value_end) { throw DAU() << "serialized value of argument " << positional->help.flags[0] << " is corrupt"; }
+		assigned_options[positional->varptr()] = positional->help.flags[0];
+	}
+	return arguments;
+}
+
+std::vector<std::string>
+clop_t::deserialize(int fd) {
+
+	// a file (or memfd) is read from the start without moving its offset, which forked workers share
+	struct stat st;
+	if (fstat(fd, &st)) { throw DAU() << "cannot read serialized options: " << strerror(errno); }
+	if (S_ISREG(st.st_mode)) { 
+		if (st.st_size == 0) { return this->deserialize("", 0); } // throws
+		void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) { throw DAU() << "cannot read serialized options: " << strerror(errno); }
+		try { 
+			std::vector<std::string> arguments = this->deserialize((const char *)mapped, st.st_size);
+			munmap(mapped, st.st_size);
+			return arguments;
+		} catch (...) { 
+			munmap(mapped, st.st_size);
+			throw;
+		}
+	}
+
+	// anything else (e.g., a pipe) is read to the end
+	std::string blob;
+	char buffer[65536];
+	for (;;) { 
+		const ssize_t n = read(fd, buffer, sizeof(buffer));
+		if (n < 0 && errno != EINTR) { throw DAU() << "cannot read serialized options: " << strerror(errno); }
+		if (n == 0) { break; }
+		if (n > 0) { blob.append(buffer, n); }
+	}
+	return this->deserialize(blob.data(), blob.size());
+}
+
+// cache file is: magic, version, command line (to check for hash collisions), serialized state, checksum
+const char CACHE_MAGIC[] = "CLPC";
+const uint32_t CACHE_VERSION = 1;
+
+std::string
+clop_t::cache_path(const int argc, const char * const * const argv) const {
+
+	// key is the declared options, parse settings, and the command line
+	std::ostringstream oss; 
+	oss << this->schema_hash() << this->hypen_arg_error << this->interpret_double_hypen;
+	uint64_t key = fnv1a(14695981039346656037ULL, oss.str());
+	for (int a = 1; a < argc; a++) { 
+		key = fnv1a(key, argv[a]);
+	}
+	char name[64];
+	snprintf(name, sizeof(name), "/clop-%016llx.cache", (unsigned long long)key);
+	return cache_directory + name;
+}
+
+bool
+clop_t::load_cache(const int argc, const char * const * const argv, std::vector<std::string> &arguments) {
+
+	const int fd = open(this->cache_path(argc, argv).c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st;
+	void *mapped = MAP_FAILED;
+	if (!fstat(fd, &st) && st.st_size > 0 && st.st_uid == geteuid()) { // someone else's file could inject option values
+		mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	if (mapped != MAP_FAILED) { 
+		futimens(fd, NULL); // mark it used, so prune_cache keeps it
+	}
+	close(fd);
+	if (mapped == MAP_FAILED) { return false; }
+
+	// check everything before trusting the serialized state
+	const char *start = (const char *)mapped, *p = start, *end = start + st.st_size;
+	bool hit = false;
+	uint32_t version; 
+	uint64_t count, size, checksum;
+	if ((size_t)(end - p) > 4 + sizeof(checksum) && !memcmp(p, CACHE_MAGIC, 4)) { 
+		end -= sizeof(checksum);
+		memcpy(&checksum, end, sizeof(checksum));
+		p += 4;
+		hit = checksum == fnv1a(14695981039346656037ULL, start, end - start)
+			&& decode_value(p, end, &version) && version == CACHE_VERSION
+			&& decode_value(p, end, &count) && count == (uint64_t)(argc > 0 ? argc - 1 : 0);
+		for (int a = 1; hit && a < argc; a++) { 
+			uint32_t length; 
+			hit = decode_value(p, end, &length) && length == strlen(argv[a]) && (size_t)(end - p) >= length && !memcmp(p, argv[a], length);
+			p += hit ? length : 0;
+		}
+		hit = hit && decode_value(p, end, &size) && size == (uint64_t)(end - p);
+	}
+	if (hit) { 
+		try { 
+			arguments = this->deserialize(p, end - p);
+			// the restored state must encode exactly as the state parse saved, or it isn't the same
+			// (the cached state is then overwritten when parse runs after the miss)
+			const std::string restored = this->serialize(arguments);
+			hit = restored.size() == (size_t)(end - p) && !memcmp(restored.data(), p, end - p);
+		} catch (const dau_t &) { 
+			hit = false;  // e.g., options have changed since it was cached
+		}
+	}
+	munmap(mapped, st.st_size);
+	return hit;
+}
+
+void
+clop_t::save_cache(const int argc, const char * const * const argv, const std::vector<std::string> &arguments) const {
+
+	std::string contents(CACHE_MAGIC, 4);
+	encode_value(contents, CACHE_VERSION);
+	encode_value(contents, (uint64_t)(argc > 0 ? argc - 1 : 0));
+	for (int a = 1; a < argc; a++) { 
+		encode_value(contents, std::string(argv[a]));
+	}
+	const std::string blob = this->serialize(arguments);
+	encode_value(contents, (uint64_t)blob.size());
+	contents += blob;
+	encode_value(contents, fnv1a(14695981039346656037ULL, contents.data(), contents.size()));
+
+	// write to a file of our own, then rename it into place, so readers never see a partly written file
+	// and concurrent writers just replace one another.  the cache is only an optimization, so failures are ignored
+	mkdir(cache_directory.c_str(), 0700);
+	const std::string path = this->cache_path(argc, argv);
+	std::ostringstream tmp; 
+	tmp << path << "." << getpid() << ".tmp";
+	const int fd = open(tmp.str().c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+	if (fd < 0) { return; }
+	bool ok = true;
+	for (size_t done = 0; ok && done < contents.size(); ) { 
+		const ssize_t n = write(fd, contents.data() + done, contents.size() - done);
+		ok = n > 0 || (n < 0 && errno == EINTR);
+		if (n > 0) { done += n; }
+	}
+	ok = !close(fd) && ok;
+	if (!ok || rename(tmp.str().c_str(), path.c_str())) { 
+		unlink(tmp.str().c_str());
+	}
+}
+
+void
+clop_t::prune_cache() const {
+
+	if (cache_days <= 0) { return; }
+	DIR *dir = opendir(cache_directory.c_str());
+	if (!dir) { return; }
+	const time_t cutoff = time(NULL) - (time_t)cache_days * 24 * 60 * 60;
+	for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) { 
+		// only our files: cache files, and temporary files left by writers that died
+		const std::string name = entry->d_name;
+		if (name.compare(0, 5, "clop-") || (name.find(".cache") == std::string::npos)) { continue; }
+		const std::string path = cache_directory + "/" + name;
+		struct stat st;
+		if (!lstat(path.c_str(), &st) && S_ISREG(st.st_mode) && st.st_uid == geteuid() && st.st_mtime < cutoff) { 
+			unlink(path.c_str());
+		}
+	}
+	closedir(dir);
+}
+
 // subroutine for clop_t::help
 // print a paragraph, break at white space best you can
 //	w1 = chars remaining on line 1
@@ -203,12 +661,50 @@ clop_t::help(FILE *out, const char *synopsis, const char *version, const char *u
 	pbreak(out, CLOP_COMPILE_INFO, termwidth - 15, termwidth, "\n");
 	fputs("\n\n", out);
 	#endif
+	std::string usage_generated; // if no usage is given, make one up from the positional arguments
+	if (!usage && positionals.size()) {
+		usage_generated = "[options]";
+		for (size_t p = 0; p < positionals.size(); ++p) { 
+			const positional_t *positional = positionals[p];
+			const std::string one = "<" + positional->help.flags[0] + ">";
+			std::string group = one;
+			for (size_t a = 1; a < positional->arity; ++a) { 
+				group += " " + one;
+			}
+			usage_generated += positional->variadic ? (" [" + group + " ...]") : (" " + group);
+		}
+		usage = usage_generated.c_str();
+	}
 	if (usage) { 
 		fprintf(out, "%sUsage%s:  ", HON.c_str(), HOFF.c_str());
 		pbreak(out, usage, termwidth - 8, termwidth, "\n"); 
 		fputs("\n\n", out);
 	}
 
+	// print positional arguments
+	if (positionals.size()) { 
+		fprintf(out, "%sArguments%s", HON.c_str(), HOFF.c_str()); 
+		pbreak(out, ":", termwidth - 9, termwidth, "\n"); 
+		fputs("\n\n", out);
+	}
+	for (size_t p = 0; p < positionals.size(); ++p) {
+		const positional_t *positional = positionals[p]; 
+		fprintf(out, "    %s%s%s", OL_HON.c_str(), positional->help.flags[0].c_str(), HOFF.c_str());
+		fputc(' ', out);
+		if (positional->arity > 1) { 
+			fprintf(out, "%lu x ", (unsigned long)positional->arity);
+		}
+		fprintf(out, "%s%s%s", OT_HON.c_str(), positional->help.metavar.c_str(), HOFF.c_str());
+		if (positional->variadic) { 
+			fputs(" ...", out);
+		}
+		char arg_delim[] = "\n        ";
+		char arg_delen = strlen(arg_delim) - 1;
+		fprintf(out, "%s", arg_delim);
+		pbreak(out, positional->help.description.c_str(), termwidth - arg_delen, termwidth - arg_delen, arg_delim); 
+		fputs("\n\n", out);
+	}
+
 	// print options
 	if (options.size()) { 
 		fprintf(out, "%sOptions%s", HON.c_str(), HOFF.c_str()); 
@@ -232,7 +728,7 @@ clop_t::help(FILE *out, const char *synopsis, const char *version, const char *u
 		fprintf(out, "%s", opt_delim);
 		std::ostringstream help_description_oss; 
 		help_description_oss << option->help.description; 
-		if (option->requires_value() && print_default_value) {
+		if (option->requires_value() && print_default_value && !option->help.default_value.empty()) {
 			help_description_oss << DF_HON << " (default: " << option->help.default_value << ")" << HOFF;
 		}
 		pbreak(out, help_description_oss.str().c_str(), termwidth - opt_delen, termwidth - opt_delen, opt_delim); 
@@ -288,7 +784,7 @@ std::ostream& operator<<(std::ostream &out, const option_t &option) {
 		}
 	}
 	out << ":" << option.help.metavar; 
-	if (option.requires_value()) {
+	if (option.requires_value() && !option.help.default_value.empty()) {
 		out << "=" << option.help.default_value; 
 	}
 	return out;
@@ -104,6 +104,72 @@
 	info:  <date at compile time>" when the compiled program prints a
 	clop_t::help(...) message.
 
+	A variable of type lazy_t<T> (e.g., lazy_t<pattern_t>) only records its
+	argument when the command line is parsed.  It is converted to a T the
+	first time it is read (with lazy_t::get, operator*, or operator->) and the
+	result is kept.  If the argument can't be converted, the exception is
+	thrown then, and names the flag and the argument's position in argv.  The
+	lazy_t constructor can take a default value.  Use this for types that are
+	expensive to construct and may not be used in every run.
+
+	clop_t::add_action adds an option that calls a function each time it is
+	used instead of setting a variable, e.g., 
+	add_action([&verbosity]() { verbosity++; }, "-v", "--verbose", "...")
+	or add_action<int>([&](const int &n) { ... }, "-n", "..."), which is
+	called with its argument converted to int.  Actions may be used more than
+	once on the command line.
+
+	clop_t::parse(argc, argv, positional) calls the function `positional' with
+	each non-option argument as soon as it is found instead of returning them
+	all at the end, so a program can start work on arguments (and options
+	before them) while parsing.  Note that an error later on the command line
+	is thrown after earlier arguments have been passed to `positional'.
+
+	Positional arguments can be declared with clop_t::add_positional, in
+	order, e.g., add_positional(&name, "name", "your name") for a single
+	argument, add_positional(&xyz, "origin", "...", 3, false) for exactly three
+	values in a std::vector, or add_positional(&points, "point", "...", 2) for
+	any number of pairs (a "variadic" list; only one is allowed).  parse then
+	checks the number of arguments, converts them into the variables (long
+	numeric lists in parallel, across threads), and returns an empty list.
+	The declared arguments are listed in the help message, which also makes up
+	a usage line from them if none is given.  Since parse throws if the
+	arguments don't fit, a help option should be an action that prints help
+	and exits.
+
+	clop_t::serialize encodes the parsed state (which options are set, their
+	values, positional arguments, and a list of arguments such as the result of
+	parse) as a compact binary string, or writes it to a file descriptor (e.g.,
+	a memfd or pipe inherited by worker processes).  A process that declares
+	the same options can call clop_t::deserialize on it instead of parse:
+	numbers and strings are copied back without conversion (other types keep
+	their argument as given, and convert it again), and lazy_t options get back
+	their unconverted argument.  Actions are not called again.  The blob is
+	tied to the declared options by clop_t::schema_hash, and deserialize throws
+	if they don't match.  The whole blob (its layout and every value) is
+	checked before anything is assigned.  Options that weren't set keep their
+	current values, so deserialize should be called on a newly built parser.
+	deserialize(fd) reads a file or memfd from the start, whatever its offset,
+	so several workers can read the same one.  A pipe is read to the end, so
+	each worker must close its copy of the write end.
+
+	If the public clop_t member cache_directory is set, parse(argc, argv)
+	caches its results there, in a file named for a hash of the declared
+	options (see schema_hash), the parse settings, and the command line.  If
+	the same program is called again with the same command line, parse
+	memory-maps the file and restores the state with deserialize instead of
+	parsing.  A cache file is only used if its checksum and its copy of the
+	command line match, so changed options or arguments just miss.  It is also
+	a miss if the restored state doesn't encode exactly as parse saved it.
+	Files are written under a temporary name and renamed into place, so
+	concurrent writers are safe.  Caching is skipped if any actions are
+	declared (they must be called), and isn't done by the parse that calls a
+	function for each argument.  The directory and files are created readable
+	only by their owner, and files owned by anyone else are ignored.  When
+	parse writes a cache file, it removes any of its own that haven't been used
+	for cache_days days (30 by default; 0 keeps them all, and then the
+	directory grows without limit until the caller cleans it).
+
 	This library also provides `procinfo` which takes the argc,argv command
 	line arguments and returns a string listing the calling information:
 	program name, program version, CLOP_COMPILE_INFO if available (see above),
@@ -117,10 +183,19 @@
 #include <cstdio>
 #include <cstdarg>
 #include <cassert>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <cctype>
+#include <cstdint>
 
 #include <vector>
 #include <map>
 #include <sstream>
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
 
 #include "dau.h"
 namespace noto {
@@ -133,6 +208,101 @@ struct help_t {
 	std::string default_value; // original (i.e, default) value of variable
 };
 
+// binary encoding of values (for clop_t::serialize).  numbers are copied as bytes and strings with their
+// length.  decode_value advances p past the value, and returns false if the encoding is malformed
+// (with a NULL value, it only checks the encoding and skips over it)
+inline void encode_bytes(std::string &blob, const void *bytes, size_t size) { blob.append((const char*)bytes, size); }
+inline bool decode_bytes(const char *&p, const char *end, void *bytes, size_t size) { 
+	if ((size_t)(end - p) < size) { return false; }
+	if (bytes) { memcpy(bytes, p, size); }
+	p += size;
+	return true;
+}
+
+inline void encode_value(std::string &blob, const std::string &value) { 
+	const uint32_t size = value.size();
+	encode_bytes(blob, &size, sizeof(size)); 
+	blob.append(value); 
+}
+inline bool decode_value(const char *&p, const char *end, std::string *value) { 
+	uint32_t size;
+	if (!decode_bytes(p, end, &size, sizeof(size)) || (size_t)(end - p) < size) { return false; }
+	if (value) { value->assign(p, size); }
+	p += size;
+	return true;
+}
+
+// c-style strings may be NULL
+inline void encode_value(std::string &blob, const char *value) { 
+	const uint8_t null = (value == NULL);
+	encode_bytes(blob, &null, sizeof(null)); 
+	if (value) { encode_value(blob, std::string(value)); }
+}
+inline void encode_value(std::string &blob, char *value) { encode_value(blob, (const char*)value); }
+inline bool decode_value(const char *&p, const char *end, const char **value) { 
+	uint8_t null; 
+	std::string str; 
+	if (!decode_bytes(p, end, &null, sizeof(null))) { return false; }
+	if (null) { if (value) { *value = NULL; } return true; }
+	if (!decode_value(p, end, value ? &str : NULL)) { return false; }
+	if (!value) { return true; }
+	char *value_cstr = new char[str.size()+1]; 
+	strcpy(value_cstr, str.c_str()); 
+	*value = value_cstr;
+	return true;
+}
+inline bool decode_value(const char *&p, const char *end, char **value) { return decode_value(p, end, (const char **)value); }
+
+template <typename T> void encode_value(std::string &blob, const T &value) { 
+	static_assert(std::is_arithmetic<T>::value, "only numbers are copied as bytes");
+	encode_bytes(blob, &value, sizeof(T)); 
+}
+template <typename T> bool decode_value(const char *&p, const char *end, T *value) { 
+	static_assert(std::is_arithmetic<T>::value, "only numbers are copied as bytes");
+	return decode_bytes(p, end, value, sizeof(T)); 
+}
+
+// types encode_value copies exactly.  options and positional arguments of other types (which may not
+// survive operator<< and operator>> unchanged) keep the argument as given, and convert it again
+template <typename T> struct exactly_encodable : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_same<T,std::string>::value 
+	|| std::is_same<T,char*>::value || std::is_same<T,const char*>::value> { };
+
+// lists of numbers are copied as one block (but std::vector<bool> is packed, so it's done one at a time)
+template <typename T> struct block_encodable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T,bool>::value> { };
+
+template <typename T> void encode_values(std::string &blob, const std::vector<T> &values, std::true_type) { encode_bytes(blob, values.data(), values.size() * sizeof(T)); }
+template <typename T> void encode_values(std::string &blob, const std::vector<T> &values, std::false_type) { 
+	for (size_t i = 0; i < values.size(); ++i) { encode_value(blob, static_cast<const T&>(values[i])); }
+}
+template <typename T> void encode_values(std::string &blob, const std::vector<T> &values) { 
+	const uint64_t size = values.size();
+	encode_bytes(blob, &size, sizeof(size)); 
+	encode_values(blob, values, block_encodable<T>());
+}
+
+template <typename T> bool decode_values(const char *&p, const char *end, std::vector<T> *values, std::true_type) { 
+	uint64_t size;
+	if (!decode_bytes(p, end, &size, sizeof(size)) || (uint64_t)(end - p) / sizeof(T) < size) { return false; }
+	if (!values) { return decode_bytes(p, end, NULL, size * sizeof(T)); }
+	values->resize(size);
+	return decode_bytes(p, end, values->data(), size * sizeof(T));
+}
+template <typename T> bool decode_values(const char *&p, const char *end, std::vector<T> *values, std::false_type) { 
+	uint64_t size;
+	if (!decode_bytes(p, end, &size, sizeof(size)) || (uint64_t)(end - p) < size) { return false; } // every value takes at least a byte
+	if (values) { 
+		values->clear();
+		values->reserve(size);
+	}
+	for (uint64_t i = 0; i < size; ++i) { 
+		T value; 
+		if (!decode_value(p, end, values ? &value : NULL)) { return false; }
+		if (values) { values->push_back(value); }
+	}
+	return true;
+}
+template <typename T> bool decode_values(const char *&p, const char *end, std::vector<T> *values) { return decode_values(p, end, values, block_encodable<T>()); }
+
 // option base class.  subclasses will be parameterized by variable type 
 class option_t { 
 
@@ -145,7 +315,13 @@ class option_t {
 	// functions to be overridden with parameterized subclass
 	virtual bool requires_value() const = 0; // does the option require an argument (not true only for booleans)
 	virtual void assign(const std::string &value) = 0; // assign a value to the variable
+	virtual void assign_at(const std::string &value, const std::string &, int) { this->assign(value); } // assign a value given by a flag at argv[argi] (only lazy options care where it came from)
 	virtual void toggle() = 0;  // toggle a (boolean) value
+	virtual bool repeatable() const { return false; } // may the option be used more than once?
+	virtual bool has_side_effects() const { return false; } // does using the option do more than set its variable?
+	virtual void encode(std::string &blob) const = 0; // append binary encoding of the variable's value (see clop_t::serialize)
+	virtual bool decode(const char *&p, const char *end) = 0; // read variable's value from binary encoding, advance p (false if malformed)
+	virtual bool check(const char *p, const char *end) const = 0; // is [p, end) exactly one encoding that decode can read?
 	virtual const void* varptr() const = 0; // get a const pointer to the option's variable
 	virtual ~option_t() { } 
 
@@ -158,6 +334,7 @@ class typed_option_t : public option_t {
   public:
 
 	T *variable;  // variable to assign value to
+	std::string argument;  // argument assigned, kept to serialize types that aren't exactly_encodable
 
 	typed_option_t(T *v, const help_t &h) : option_t(h), variable(v) { }
 
@@ -165,6 +342,23 @@ class typed_option_t : public option_t {
 	void toggle(); 
 	const void* varptr() const { return (const void*)variable; }
 	bool requires_value() const; 
+	void encode(std::string &blob) const { this->encode(blob, exactly_encodable<T>()); }
+	bool decode(const char *&p, const char *end) { return this->decode(p, end, exactly_encodable<T>()); }
+	bool check(const char *p, const char *end) const { return this->check(p, end, exactly_encodable<T>()) && p == end; }
+
+  private:
+
+	void encode(std::string &blob, std::true_type) const { encode_value(blob, *variable); }
+	void encode(std::string &blob, std::false_type) const { encode_value(blob, argument); }
+	bool check(const char *&p, const char *end, std::true_type) const { return decode_value(p, end, (T*)NULL); }
+	bool check(const char *&p, const char *end, std::false_type) const { return decode_value(p, end, (std::string*)NULL); }
+	bool decode(const char *&p, const char *end, std::true_type) { return decode_value(p, end, variable); }
+	bool decode(const char *&p, const char *end, std::false_type) { 
+		std::string value; 
+		if (!decode_value(p, end, &value)) { return false; }
+		this->assign(value); 
+		return true;
+	}
 };
 
 // does an option require a value? 
@@ -177,6 +371,7 @@ inline bool typed_option_t<bool>::requires_value() const { return false; }
 // how to assign a value to an option's variable 
 template <typename T>
 void typed_option_t<T>::assign(const std::string &value) { 
+	this->argument = value;
 	std::istringstream iss(value); 
 	iss >> (*(this->variable)); 
 }
@@ -219,19 +414,356 @@ template<>
 // inline void typed_option_t<bool>::toggle() { *(this->variable) = (!(*(this->variable))); }
 inline void typed_option_t<bool>::toggle() { *(this->variable) = ( (this->help.default_value == std::string("0")) ? true : false ); } // change to !default (in case weirdo user calls parse more than once)
 
+// convert a string to a variable's type, return false if it cannot be done (or if there is anything left over)
+template <typename T>
+bool convert_value(const std::string &value, T *variable) { 
+	std::istringstream iss(value); 
+	iss >> (*variable); 
+	return !iss.fail() && (iss >> std::ws).eof();
+}
+
+// strings are taken verbatim (see typed_option_t<std::string>::assign)
+template <>
+inline bool convert_value(const std::string &value, std::string *variable) { *variable = value; return true; }
+
+// c-style strings need space allocated (see typed_option_t<char*>::assign)
+template <>
+inline bool convert_value(const std::string &value, const char **variable) { 
+	char *value_cstr = new char[value.size()+1]; 
+	strcpy(value_cstr, value.c_str()); 
+	*variable = value_cstr;
+	return true;
+}
+template <>
+inline bool convert_value(const std::string &value, char **variable) { return convert_value(value, (const char **)variable); }
+
+// numbers are read with strto* functions, which are much faster than istringstream (this matters for
+// long lists of positional arguments).  they must use the whole string, except for surrounding whitespace
+inline bool convert_rest_blank(const char *end) { while (isspace((unsigned char)*end)) { end++; } return !*end; }
+template <>
+inline bool convert_value(const std::string &value, long *variable) { 
+	char *end; 
+	errno = 0;
+	*variable = strtol(value.c_str(), &end, 10); 
+	return end != value.c_str() && errno != ERANGE && convert_rest_blank(end);
+}
+template <>
+inline bool convert_value(const std::string &value, unsigned long *variable) { 
+	const char *start = value.c_str();
+	while (isspace((unsigned char)*start)) { start++; }
+	if (*start == '-') { return false; } // strtoul would negate it
+	char *end; 
+	errno = 0;
+	*variable = strtoul(value.c_str(), &end, 10); 
+	return end != value.c_str() && errno != ERANGE && convert_rest_blank(end);
+}
+template <>
+inline bool convert_value(const std::string &value, int *variable) { 
+	long l;
+	if (!convert_value(value, &l) || l < INT_MIN || l > INT_MAX) { return false; }
+	*variable = (int)l;
+	return true;
+}
+template <>
+inline bool convert_value(const std::string &value, unsigned int *variable) { 
+	unsigned long ul;
+	if (!convert_value(value, &ul) || ul > UINT_MAX) { return false; }
+	*variable = (unsigned int)ul;
+	return true;
+}
+template <>
+inline bool convert_value(const std::string &value, double *variable) { 
+	char *end; 
+	errno = 0;
+	*variable = strtod(value.c_str(), &end); 
+	return end != value.c_str() && errno != ERANGE && convert_rest_blank(end);
+}
+template <>
+inline bool convert_value(const std::string &value, float *variable) { 
+	char *end; 
+	errno = 0;
+	*variable = strtof(value.c_str(), &end); 
+	return end != value.c_str() && errno != ERANGE && convert_rest_blank(end);
+}
+
+// convert args[begin+lo, begin+hi) to out[lo, hi), return the index of the first one that can't be converted (or hi)
+template <typename T>
+size_t convert_range(const std::vector<std::string> &args, size_t begin, T *out, size_t lo, size_t hi) { 
+	for (size_t i = lo; i < hi; ++i) { 
+		if (!convert_value(args[begin + i], out + i)) { return i; }
+	}
+	return hi;
+}
+
+// convert args[begin, begin+out.size()) to out, splitting the work across threads if they are numbers and
+// there are a lot of them (other types' operator>> may throw, which would terminate a thread, or not be
+// safe to run concurrently).  return the index of the first one that can't be converted (or out.size())
+template <typename T>
+size_t convert_values(const std::vector<std::string> &args, size_t begin, std::vector<T> &out) { 
+
+	const size_t count = out.size();
+	const size_t MIN_PER_THREAD = 16384;  // fewer than this, and starting a thread isn't worth it
+	const size_t nthreads = std::min<size_t>(std::thread::hardware_concurrency(), count / MIN_PER_THREAD);
+	if (nthreads < 2 || !std::is_arithmetic<T>::value) { return convert_range(args, begin, out.data(), 0, count); }
+
+	std::vector<size_t> bad(nthreads);  // first argument each thread couldn't convert (or end of its range)
+	std::vector<std::thread> threads; 
+	for (size_t t = 0; t < nthreads; ++t) { 
+		const size_t lo = count * t / nthreads, hi = count * (t + 1) / nthreads;
+		threads.push_back(std::thread([&args, begin, &out, &bad, t, lo, hi]() { bad[t] = convert_range(args, begin, out.data(), lo, hi); }));
+	}
+	for (size_t t = 0; t < nthreads; ++t) { threads[t].join(); }
+	for (size_t t = 0; t < nthreads; ++t) { 
+		if (bad[t] != count * (t + 1) / nthreads) { return bad[t]; }
+	}
+	return count;
+}
+
+// std::vector<bool> is packed, so it can't be written from several threads (or through a bool*)
+inline size_t convert_values(const std::vector<std::string> &args, size_t begin, std::vector<bool> &out) { 
+	for (size_t i = 0; i < out.size(); ++i) { 
+		bool b; 
+		if (!convert_value(args[begin + i], &b)) { return i; }
+		out[i] = b;
+	}
+	return out.size();
+}
+
+// variable whose value is converted from its argument only when it is first read.  for types that are
+// expensive to construct (e.g., patterns, parsed expressions) and may not be used in every run.
+template <typename T>
+class lazy_t {
+
+  private:
+
+	mutable T value;  // converted (or default) value
+	mutable bool pending;  // argument given but not yet converted?
+	std::string raw;  // argument as given on the command line
+	std::string flag;  // flag that gave the argument
+	int argi;  // position of the argument in argv
+
+  public:
+
+	lazy_t() : value(), pending(false), argi(0) { }
+	lazy_t(const T &v) : value(v), pending(false), argi(0) { } // default value
+
+	// record an argument to be converted later (called by clop_t::parse)
+	void defer(const std::string &arg, const std::string &f, int a) { raw = arg; flag = f; argi = a; pending = true; }
+
+	// convert argument (the first time only) and return value
+	const T& get() const; 
+	const T& operator*() const { return this->get(); }
+	const T* operator->() const { return &(this->get()); }
+
+	bool converted() const { return !pending; }  // false only if an argument is waiting to be converted
+	const std::string& argument() const { return raw; }  // argument as given on the command line, if any
+
+	// binary encoding of the argument, not the converted value (see clop_t::serialize)
+	void encode(std::string &blob) const { encode_value(blob, raw); encode_value(blob, flag); encode_value(blob, argi); }
+	bool decode(const char *&p, const char *end) { 
+		std::string a, f; 
+		int i; 
+		if (!decode_value(p, end, &a) || !decode_value(p, end, &f) || !decode_value(p, end, &i)) { return false; }
+		this->defer(a, f, i);
+		return true;
+	}
+	bool check(const char *p, const char *end) const { 
+		return decode_value(p, end, (std::string*)NULL) && decode_value(p, end, (std::string*)NULL) && decode_value(p, end, (int*)NULL) && p == end;
+	}
+};
+
+template <typename T>
+const T& lazy_t<T>::get() const {
+	if (pending) { 
+		if (!convert_value(raw, &value)) { throw DAU() << "option " << flag << " (argv[" << argi << "]): cannot convert \"" << raw << "\""; }
+		pending = false;
+	}
+	return value;
+}
+
+// lazy options only record their argument at parse time
+template <typename T>
+class typed_option_t< lazy_t<T> > : public option_t {
+
+  public:
+
+	lazy_t<T> *variable;  // variable to assign value to
+
+	typed_option_t(lazy_t<T> *v, const help_t &h) : option_t(h), variable(v) { }
+
+	void assign(const std::string &value) { variable->defer(value, help.flags[0], 0); }
+	void assign_at(const std::string &value, const std::string &flag, int argi) { variable->defer(value, flag, argi); }
+	void toggle() { assert(false); } // can't toggle an assigned-value option
+	const void* varptr() const { return (const void*)variable; }
+	bool requires_value() const { return true; }
+	void encode(std::string &blob) const { variable->encode(blob); }
+	bool decode(const char *&p, const char *end) { return variable->decode(p, end); }
+	bool check(const char *p, const char *end) const { return variable->check(p, end); }
+};
+
+// option that calls a function (with its argument converted to T) each time it is used, instead of setting a variable
+template <typename T>
+class action_option_t : public option_t {
+
+  public:
+
+	std::function<void(const T&)> action;  // what to do with each argument
+
+	action_option_t(const std::function<void(const T&)> &a, const help_t &h) : option_t(h), action(a) { }
+
+	void assign(const std::string &value) { this->assign_at(value, help.flags[0], 0); }
+	void assign_at(const std::string &value, const std::string &flag, int argi) { 
+		T converted; 
+		if (!convert_value(value, &converted)) { throw DAU() << "option " << flag << " (argv[" << argi << "]): cannot convert \"" << value << "\""; }
+		action(converted); 
+	}
+	void toggle() { assert(false); } // can't toggle an assigned-value option
+	const void* varptr() const { return (const void*)this; } // no variable, but the option itself is unique
+	bool requires_value() const { return true; }
+	bool repeatable() const { return true; }
+	bool has_side_effects() const { return true; }
+	void encode(std::string &) const { } // nothing to keep: the action has already been done
+	bool decode(const char *&, const char *) { return true; }
+	bool check(const char *p, const char *end) const { return p == end; }
+};
+
+// option that calls a function (with no argument) each time it is used
+template <>
+class action_option_t<void> : public option_t {
+
+  public:
+
+	std::function<void()> action;  // what to do for each use
+
+	action_option_t(const std::function<void()> &a, const help_t &h) : option_t(h), action(a) { }
+
+	void assign(const std::string &) { assert(false); } // actions without arguments are never assigned a value
+	void toggle() { action(); }
+	const void* varptr() const { return (const void*)this; } // no variable, but the option itself is unique
+	bool requires_value() const { return false; }
+	bool repeatable() const { return true; }
+	bool has_side_effects() const { return true; }
+	void encode(std::string &) const { } // nothing to keep: the action has already been done
+	bool decode(const char *&, const char *) { return true; }
+	bool check(const char *p, const char *end) const { return p == end; }
+};
+
+// positional argument base class.  subclasses will be parameterized by variable type
+class positional_t { 
+
+  public: 
+
+	const help_t help;  // help info (flags holds just the argument name)
+	const size_t arity;  // number of arguments (per group, if variadic)
+	const bool variadic;  // takes any number of groups of `arity' arguments?
+
+	positional_t(const help_t &h, size_t a, bool v) : help(h), arity(a), variadic(v) { }
+
+	// functions to be overridden with parameterized subclass
+	virtual void assign(const std::vector<std::string> &args, size_t begin, size_t count) = 0; // assign args[begin, begin+count) to the variable
+	virtual const void* varptr() const = 0; // get a const pointer to the argument's variable
+	virtual void encode(std::string &blob) const = 0; // append binary encoding of the variable's value (see clop_t::serialize)
+	virtual bool decode(const char *&p, const char *end) = 0; // read variable's value from binary encoding, advance p (false if malformed)
+	virtual bool check(const char *p, const char *end) const = 0; // is [p, end) exactly one encoding that decode can read?
+	virtual ~positional_t() { } 
+
+};
+
+// a single positional argument
+template <typename T>
+class typed_positional_t : public positional_t {
+
+  public:
+
+	T *variable;  // variable to assign value to
+	std::string argument;  // argument assigned, kept to serialize types that aren't exactly_encodable
+
+	typed_positional_t(T *v, const help_t &h) : positional_t(h, 1, false), variable(v) { }
+
+	void assign(const std::vector<std::string> &args, size_t begin, size_t count) { 
+		assert(count == 1);
+		argument = args[begin];
+		if (!convert_value(args[begin], variable)) { throw DAU() << "argument " << help.flags[0] << ": cannot convert \"" << args[begin] << "\""; }
+	}
+	const void* varptr() const { return (const void*)variable; }
+	void encode(std::string &blob) const { this->encode(blob, exactly_encodable<T>()); }
+	bool decode(const char *&p, const char *end) { return this->decode(p, end, exactly_encodable<T>()); }
+	bool check(const char *p, const char *end) const { return this->check(p, end, exactly_encodable<T>()) && p == end; }
+
+  private:
+
+	void encode(std::string &blob, std::true_type) const { encode_value(blob, *variable); }
+	void encode(std::string &blob, std::false_type) const { encode_value(blob, argument); }
+	bool check(const char *&p, const char *end, std::true_type) const { return decode_value(p, end, (T*)NULL); }
+	bool check(const char *&p, const char *end, std::false_type) const { return decode_value(p, end, (std::string*)NULL); }
+	bool decode(const char *&p, const char *end, std::true_type) { return decode_value(p, end, variable); }
+	bool decode(const char *&p, const char *end, std::false_type) { return decode_value(p, end, &argument) && convert_value(argument, variable); }
+};
+
+// a list of positional arguments, converted in parallel if there are a lot of them
+template <typename T>
+class typed_positional_t< std::vector<T> > : public positional_t {
+
+  public:
+
+	std::vector<T> *variable;  // variable to assign values to
+	std::vector<std::string> arguments;  // arguments assigned, kept (only) to serialize types that aren't exactly_encodable
+
+	typed_positional_t(std::vector<T> *v, const help_t &h, size_t a, bool va) : positional_t(h, a, va), variable(v) { }
+
+	void assign(const std::vector<std::string> &args, size_t begin, size_t count) { 
+		this->keep(args, begin, count, exactly_encodable<T>());
+		variable->assign(count, T());
+		const size_t bad = convert_values(args, begin, *variable);
+		if (bad != count) { throw DAU() << "argument " << help.flags[0] << " #" << (bad + 1) << ": cannot convert \"" << args[begin + bad] << "\""; }
+	}
+	const void* varptr() const { return (const void*)variable; }
+	void encode(std::string &blob) const { this->encode(blob, exactly_encodable<T>()); }
+	bool decode(const char *&p, const char *end) { return this->decode(p, end, exactly_encodable<T>()); }
+	bool check(const char *p, const char *end) const { return this->check(p, end, exactly_encodable<T>()) && p == end; }
+
+  private:
+
+	bool check(const char *&p, const char *end, std::true_type) const { return decode_values(p, end, (std::vector<T>*)NULL); }
+	bool check(const char *&p, const char *end, std::false_type) const { return decode_values(p, end, (std::vector<std::string>*)NULL); }
+	void keep(const std::vector<std::string> &, size_t, size_t, std::true_type) { }
+	void keep(const std::vector<std::string> &args, size_t begin, size_t count, std::false_type) { arguments.assign(args.begin() + begin, args.begin() + begin + count); }
+	void encode(std::string &blob, std::true_type) const { encode_values(blob, *variable); }
+	void encode(std::string &blob, std::false_type) const { encode_values(blob, arguments); }
+	bool decode(const char *&p, const char *end, std::true_type) { return decode_values(p, end, variable); }
+	bool decode(const char *&p, const char *end, std::false_type) { 
+		if (!decode_values(p, end, &arguments)) { return false; }
+		variable->assign(arguments.size(), T());
+		return convert_values(arguments, 0, *variable) == arguments.size();
+	}
+};
+
 /** command line option parser class */
 class clop_t {
   
   private: 
 
 	std::vector<option_t*> options; // list of all options, in order (for help message)
+	std::vector<positional_t*> positionals; // list of positional arguments, in order
 	std::map<const std::string, option_t*> flagset; // flags and the variables they set
   	std::map<const void *,std::string> assigned_options; // which have been assigned?
 
+	void insert(option_t *option); // add new option to options and flagset (after checking its flags are not taken)
+	void insert(positional_t *positional); // add new positional argument (after checking it fits with the others)
+	void assign_positionals(const std::vector<std::string> &args); // check number of arguments and assign them to positionals
+
+	// cache of parse results (see cache_directory)
+	std::string cache_path(const int argc, const char * const * const argv) const; // cache file for this command line
+	bool load_cache(const int argc, const char * const * const argv, std::vector<std::string> &arguments); // restore state from cache, if it's there
+	void save_cache(const int argc, const char * const * const argv, const std::vector<std::string> &arguments) const; 
+	void prune_cache() const; // remove cache files not used for cache_days
+
   public:
 
   	bool hypen_arg_error = true; 
 	bool interpret_double_hypen = true;
+	std::string cache_directory = ""; // if given, parse results are cached in files here (see NOTES)
+	int cache_days = 30; // cache files not used for this many days are removed (none are if <= 0)
 
   	// add option to parser
 	// @param variable pointer to variable in question
@@ -240,9 +772,43 @@ class clop_t {
 	template <typename T> 
 	void add(T *variable, const char *flag, const char *help); 
 
-	// parse options and return list of non-option arguments
+	// add option that calls a function each time it is used, instead of setting a variable
+	// @param action called with the option's argument converted to T, e.g., add_action<int>(...), or with no argument
+	template <typename T> 
+	void add_action(const std::function<void(const T&)> &action, const char *shortflag, const char *longflag, const char *help); 
+	template <typename T> 
+	void add_action(const std::function<void(const T&)> &action, const char *flag, const char *help); 
+	void add_action(const std::function<void()> &action, const char *shortflag, const char *longflag, const char *help); 
+	void add_action(const std::function<void()> &action, const char *flag, const char *help); 
+
+	// declare a positional argument, to be converted and assigned (in the order declared) by parse
+	template <typename T> 
+	void add_positional(T *variable, const char *name, const char *help); 
+	// declare `arity' positional arguments for a list.  if variadic, it takes any number of groups of
+	// `arity' arguments (e.g., coordinate pairs).  only one positional argument may be variadic
+	template <typename T> 
+	void add_positional(std::vector<T> *variable, const char *name, const char *help, size_t arity=1, bool variadic=true); 
+
+	// parse options and return list of non-option arguments (empty if positional arguments are declared; they get them)
 	std::vector<std::string> parse(const int argc, const char * const * const argv); // all those consts in case user programmer uses them
 
+	// parse options and call `positional' with each non-option argument as soon as it is found (declared positional arguments are ignored)
+	void parse(const int argc, const char * const * const argv, const std::function<void(const std::string&)> &positional);
+
+	// hash of the declared options and positional arguments (their flags, types, and default values)
+	uint64_t schema_hash() const; 
+
+	// binary encoding of the parsed state (which options are set, their values, positional arguments, and
+	// `arguments', e.g., as returned by parse), written to a string or to a file descriptor
+	std::string serialize(const std::vector<std::string> &arguments=std::vector<std::string>()) const; 
+	void serialize(int fd, const std::vector<std::string> &arguments=std::vector<std::string>()) const; 
+
+	// restore the parsed state from serialize (instead of calling parse) and return its `arguments'.
+	// options must be declared as they were when serialized (see schema_hash), or it throws.  options
+	// that weren't set keep their current values, so call it on a parser that hasn't parsed anything
+	std::vector<std::string> deserialize(const char *blob, size_t size); 
+	std::vector<std::string> deserialize(int fd);  // reads a whole file from the start, or anything else (e.g., a pipe) to the end
+
 	// ask if an option is set, given its variable, or one of its flags (return false if no such option)
 	bool set(const void *variable) const { return assigned_options.find(variable)!=assigned_options.end(); } 
 	bool set(const std::string &flag) const { return flagset.find(flag)!=flagset.end() && assigned_options.find(flagset.at(flag)->varptr())!=assigned_options.end(); }
@@ -259,6 +825,9 @@ typedef clop_t OptionParser;
 inline bool legal_short_flag(const char *flag) { return !flag || (strlen(flag)==2 && flag[0]=='-' && flag[1]!='-'); }
 inline bool legal_long_flag(const char *flag) { return !flag || (strlen(flag)>=3 && flag[0]=='-' && flag[1]=='-' && std::string(flag).find('=')==std::string::npos); }
 
+// make help info (flags and description) for a new option, after checking its flags
+help_t make_help(const char *shortflag, const char *longflag, const char *description); 
+
 // What is the argument type called, based on it's variable type (pointer)? 
 template <typename T>
 std::string argument_type(T*) { return "value"; }
@@ -274,6 +843,8 @@ inline std::string argument_type(char **) { return "string"; }
 inline std::string argument_type(const char **) { return "string"; }
 inline std::string argument_type(std::string *) { return "string"; }
 inline std::string argument_type(bool *) { return ""; }
+template <typename T>
+std::string argument_type(lazy_t<T> *) { return argument_type((T*)NULL); }
 
 // get current value as string (subroutine for clop_t::add to create help.description)
 template <typename T> std::string current_value(T *variable) { std::ostringstream oss; oss << *variable; return oss.str(); }	
@@ -286,6 +857,7 @@ template <> inline std::string current_value(const char* *cstr) { if (*cstr) { s
 template <> inline std::string current_value(char* *cstr) { return current_value( (const char **)cstr ); }
 template <> inline std::string current_value(std::string *str) { std::ostringstream oss; oss << "\"" << *str << "\""; return oss.str(); }
 template <> inline std::string current_value(char *c) { std::ostringstream oss; oss << "'" << *c << "'"; return oss.str(); }
+template <typename T> std::string current_value(lazy_t<T> *variable) { return current_value(const_cast<T*>(&(variable->get()))); }
 
 template <typename T> 
 void clop_t::add(T *variable, const char *flag, const char *help) {
@@ -299,31 +871,60 @@ template <typename T>
 void clop_t::add(T *variable, const char *shortflag, const char *longflag, const char *help_description) {
 
 	if (!variable) { throw DAU() << "creation of option with NULL variable"; }
-	if (!shortflag && !longflag) { throw DAU() << "creation of option without an indicator flag"; }
-	if (shortflag && !legal_short_flag(shortflag)) { throw DAU() << "illegal option flag: " << shortflag; }
-	if (longflag && !legal_long_flag(longflag)) { throw DAU() << "illegal option name: " << longflag; }
+
+	help_t help = make_help(shortflag, longflag, help_description); 
+	help.metavar = argument_type(variable);
+	help.default_value = current_value(variable);
+
+	this->insert(new typed_option_t<T>(variable, help));
+}
+
+template <typename T> 
+void clop_t::add_action(const std::function<void(const T&)> &action, const char *flag, const char *help) {
+	if (!flag) { throw DAU() << "creation of option without an indicator flag"; }
+	if (legal_short_flag(flag)) { return this->add_action(action, flag, NULL, help); }
+	if (legal_long_flag(flag)) { return this->add_action(action, NULL, flag, help); }
+	throw DAU() << "illegal option flag/name: " << flag; 
+}
+
+template <typename T> 
+void clop_t::add_action(const std::function<void(const T&)> &action, const char *shortflag, const char *longflag, const char *help_description) {
+
+	if (!action) { throw DAU() << "creation of option with empty action"; }
+
+	help_t help = make_help(shortflag, longflag, help_description); 
+	help.metavar = argument_type((T*)NULL);
+
+	this->insert(new action_option_t<T>(action, help));
+}
+
+template <typename T> 
+void clop_t::add_positional(T *variable, const char *name, const char *help_description) {
+
+	if (!variable) { throw DAU() << "creation of positional argument with NULL variable"; }
+	if (!name || !*name) { throw DAU() << "creation of positional argument without a name"; }
 
 	help_t help; 
-	if (shortflag) { help.flags.push_back(std::string(shortflag)); }
-	if (longflag) { help.flags.push_back(std::string(longflag)); }
+	help.flags.push_back(std::string(name));
 	help.metavar = argument_type(variable);
 	help.description = help_description;
-	help.default_value = current_value(variable);
 
-	typed_option_t<T> *option = new typed_option_t<T>(variable, help);
-	this->options.push_back(option);
-	
-	for (std::map<const std::string,option_t *>::const_iterator it=flagset.begin(); it!=flagset.end(); it++) { // for each existing flag -> option
+	this->insert(new typed_positional_t<T>(variable, help));
+}
+
+template <typename T> 
+void clop_t::add_positional(std::vector<T> *variable, const char *name, const char *help_description, size_t arity, bool variadic) {
 
-		if (it->second->varptr() == variable) { throw DAU() << "option " << (*(it->second)) << " and " << (*option) << " associated with the same variable"; }
-		if (shortflag && !strcmp(it->first.c_str(),shortflag)) { throw DAU() << "option flag " << shortflag << " assigned to multiple options: (i) " << (*(it->second)) << ", and (ii) " << (*option); }
-		if (longflag && !strcmp(it->first.c_str(), longflag)) { throw DAU() << "option name " << longflag << " assigned to multiple options: (i) " << (*(it->second)) << ", and (ii) " << (*option); }
+	if (!variable) { throw DAU() << "creation of positional argument with NULL variable"; }
+	if (!name || !*name) { throw DAU() << "creation of positional argument without a name"; }
+	if (!arity) { throw DAU() << "positional argument " << name << " takes no arguments"; }
 
-	} // next previous flag,option
+	help_t help; 
+	help.flags.push_back(std::string(name));
+	help.metavar = argument_type((T*)NULL);
+	help.description = help_description;
 
-	// add these flags to flagset now
-	if (shortflag) { flagset[std::string(shortflag)] = option; }
-	if (longflag) { flagset[std::string(longflag)] = option; }
+	this->insert(new typed_positional_t< std::vector<T> >(variable, help, arity, variadic));
 }
 
 // return string with command line and version information
@@ -41,6 +41,9 @@ int main( int argc, const char **argv ) {
 	char g = '8';
 	clop.add( &g, "-g", "char option");
 
+	int verbosity = 0;
+	clop.add_action( [&verbosity]() { verbosity++; }, "-v", "--verbose", "more output (may be repeated)");
+
 	bool help = false;
 	clop.add( &help, "-h", "--help", "print usage and exit"); 
 
@@ -71,6 +74,7 @@ int main( int argc, const char **argv ) {
 	std::cout << "bool option #4 is: " << (bool4?"true":"false") << " (" << (clop.set(&bool4) ? "set" : "not set") << ")" << std::endl;
 
 	std::cout << "char option is: '" << g << "'" << std::endl;
+	std::cout << "verbosity is: " << verbosity << std::endl;
 	
 	std::cout << "all done!" << std::endl;
 